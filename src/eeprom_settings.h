@@ -3,6 +3,8 @@
 #include <EEPROM.h>
 #include <string>
 
+#include "trace.h"
+
 constexpr size_t EEPROM_SIZE = 512; 
 
 constexpr size_t EEPROM_SIZE_SSID = 32;
@@ -64,6 +66,7 @@ class EEPROM_Settings {
             }
 
             EEPROM.commit();
+            trace.record(TRACE_EEPROM_COMMIT, EEPROM_ADDR_SSID);
             EEPROM.end();
         }
 
@@ -78,6 +81,7 @@ class EEPROM_Settings {
             }
 
             EEPROM.commit();
+            trace.record(TRACE_EEPROM_COMMIT, EEPROM_ADDR_PWD);
             EEPROM.end();
         }
 
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+
+// Longest idle slice between two polls of the servers
+#ifndef IDLE_MAX_SLEEP_MS
+#define IDLE_MAX_SLEEP_MS 50
+#endif
+
+// The setup portal must keep answering DNS requests
+#ifndef IDLE_AP_MAX_SLEEP_MS
+#define IDLE_AP_MAX_SLEEP_MS 5
+#endif
+
+/*
+ * Runs loop(): poll the servers, then stay idle until the nearest deadline
+ * among the subsystems, never more than max_sleep. Busy and idle time are
+ * accounted to report the CPU utilisation.
+ *
+ * A server handles one client per poll, so after a poll that had a request
+ * in hand the loop polls again at once, and only sleeps after an empty poll.
+ * A request therefore arrived after the last empty poll: the time since that
+ * poll is an upper bound of how long it waited, busy work like an IR frame
+ * included. Its largest value is kept.
+ */
+class IdleScheduler{
+    public:
+        IdleScheduler(unsigned long max_sleep = IDLE_MAX_SLEEP_MS) :
+        max_sleep(max_sleep), next_deadline(0),
+        has_polled(false), last_served(false), last_poll_us(0), last_empty_poll_us(0)
+        {
+            reset();
+        }
+
+        void reset(){
+            busy_us = 0;
+            idle_us = 0;
+            idle_slice_max_us = 0;
+            served_wait_bound_max_us = 0;
+        }
+
+        void setMaxSleep(unsigned long ms){ max_sleep = ms; }
+        unsigned long getMaxSleep(){ return max_sleep; }
+
+        void begin(unsigned long now){
+            next_deadline = now + max_sleep;
+        }
+
+        void deadline(unsigned long at){
+            if((long)(at - next_deadline) < 0){
+                next_deadline = at;
+            }
+        }
+
+        unsigned long sleepTime(unsigned long now){
+            long remaining = (long)(next_deadline - now);
+            return remaining > 0 ? (unsigned long)remaining : 0;
+        }
+
+        /*
+         * One iteration of loop(). Loop provides micros(), millis(),
+         * pollServers() which returns true when a server had a request in
+         * hand, addDeadlines(IdleScheduler&) and idle(ms), which yields when
+         * ms is 0.
+         */
+        template<typename Loop>
+        void step(Loop& loop){
+            uint32_t start = loop.micros();
+
+            poll(start);
+            bool had_request = loop.pollServers();
+            if(had_request) served();
+
+            addBusy(loop.micros() - start);
+
+            unsigned long sleep_ms = 0;
+            if(!had_request){
+                unsigned long now = loop.millis();
+
+                begin(now);
+                loop.addDeadlines(*this);
+                sleep_ms = sleepTime(now);
+            }
+
+            uint32_t idle_start = loop.micros();
+            loop.idle(sleep_ms);
+            addIdle(loop.micros() - idle_start);
+        }
+
+        // Called right before the servers look for new requests
+        void poll(uint32_t now_us){
+            if(!has_polled || !last_served){
+                last_empty_poll_us = has_polled ? last_poll_us : now_us;
+            }
+
+            last_poll_us = now_us;
+            last_served = false;
+            has_polled = true;
+        }
+
+        // The last poll had a request in hand
+        void served(){
+            uint32_t bound = last_poll_us - last_empty_poll_us;
+
+            last_served = true;
+            if(bound > served_wait_bound_max_us) served_wait_bound_max_us = bound;
+        }
+
+        void addBusy(uint32_t us){
+            busy_us += us;
+        }
+
+        void addIdle(uint32_t us){
+            idle_us += us;
+            if(us > idle_slice_max_us) idle_slice_max_us = us;
+        }
+
+        uint64_t getBusy(){ return busy_us; }
+        uint64_t getIdle(){ return idle_us; }
+        uint32_t getIdleSliceMax(){ return idle_slice_max_us; }
+        uint32_t getServedWaitBoundMax(){ return served_wait_bound_max_us; }
+
+        float getUtilisation(){
+            uint64_t total = busy_us + idle_us;
+            return total == 0 ? 0 : float(busy_us) / float(total);
+        }
+
+    private:
+        unsigned long max_sleep;
+        unsigned long next_deadline;
+
+        bool has_polled;
+        bool last_served;
+        uint32_t last_poll_us;
+        uint32_t last_empty_poll_us;
+
+        uint64_t busy_us;
+        uint64_t idle_us;
+        uint32_t idle_slice_max_us;
+        uint32_t served_wait_bound_max_us;
+};
@@ -7,21 +7,31 @@
 #include "setting_server.h"
 #include "utils.h"
 #include "panasonic_remote.h"
+#include "request_stats.h"
+#include "room_sensor.h"
+#include "thermostat.h"
+#include "idle_scheduler.h"
 
 constexpr byte led_ir_pwm = D7;
 constexpr byte led_ir_command = D8;
 constexpr byte led_r  = D2;
 constexpr byte led_g  = D3;
 constexpr byte led_b  = D4;
+constexpr byte room_sensor_pin = D5;
 
 
 bool isAP = false;
 ESP8266WebServer webServer(80);
 EEPROM_Settings settings;
-SettingServer settingServer("IR Remote", settings);
+RequestStats stats;
+SettingServer settingServer("IR Remote", settings, stats);
 PanasonicRemote remote(led_ir_pwm, led_ir_command);
+RoomSensor roomSensor(room_sensor_pin);
+Thermostat thermostat;
+IdleScheduler scheduler;
 
 bool isOn = false;
+bool ir_pending = false;
 uint8_t temperature = 16;
 bool temp_is_half = false;
 StreamMode stream_mode = StreamMode::AUTO;
@@ -30,17 +40,41 @@ void set_red(bool enable){ digitalWrite(led_r, enable ? LOW : HIGH); }
 void set_green(bool enable){ digitalWrite(led_g, enable ? LOW : HIGH); }
 void set_blue(bool enable){ digitalWrite(led_b, enable ? LOW : HIGH); } 
 
-void configure_webserver(){
+float get_setpoint(){
+    float t = temperature;
+
+    if(temp_is_half) t += 0.5;
+
+    return t;
+}
+
+void send_command(){
+    remote
+        .setStreamMode(stream_mode)
+        .setTemperature(temperature, temp_is_half);
+        
+    if(isOn){
+        remote.turnOn();
+    }
+    else{
+        remote.turnOff();
+    }
 
-    webServer.on("/temperature", [](){
-        float t = temperature;
+    unsigned long start = millis();
+    trace.record(TRACE_IR_START);
+    remote.send();
+    trace.record(TRACE_IR_END, 0, uint16_t(millis() - start));
 
-        if(temp_is_half) t += 0.5;
+    thermostat.notifyPower(isOn, millis());
+}
 
-        webServer.send(200, "text/plain", String(t, 1));
-    });
+void configure_webserver(){
 
-    webServer.on(UriRegex("^\\/temperature/([0-9]+.?[0-9]*)?"), [&](){
+    webServer.on("/temperature", stats.wrap(ROUTE_TEMPERATURE_GET, [](){
+        webServer.send(200, "text/plain", String(get_setpoint(), 1));
+    }));
+
+    webServer.on(UriRegex("^\\/temperature/([0-9]+.?[0-9]*)?"), stats.wrap(ROUTE_TEMPERATURE_SET, [&](){
         float new_t = webServer.pathArg(0).toFloat();
 
         uint8_t int_part = uint8_t(new_t);
@@ -55,9 +89,9 @@ void configure_webserver(){
         temp_is_half = is_half;
 
         webServer.send(200, "text/plain", "");
-    });
+    }));
 
-    webServer.on("/stream_mode", [](){
+    webServer.on("/stream_mode", stats.wrap(ROUTE_STREAM_MODE_GET, [](){
         String mode = "";
         switch(stream_mode){
             case AUTO:
@@ -74,9 +108,9 @@ void configure_webserver(){
         }
 
         webServer.send(200, "text/plain", mode);
-    });
+    }));
 
-    webServer.on(UriRegex("^\\/stream_mode/(AUTO|POWERFULL|QUIET)"), [&](){
+    webServer.on(UriRegex("^\\/stream_mode/(AUTO|POWERFULL|QUIET)"), stats.wrap(ROUTE_STREAM_MODE_SET, [&](){
         String new_m = webServer.pathArg(0);
         
         if      ( new_m == "AUTO" )      stream_mode = StreamMode::AUTO;
@@ -84,36 +118,84 @@ void configure_webserver(){
         else if ( new_m == "QUIET" )     stream_mode = StreamMode::QUIET;
 
         webServer.send(200, "text/plain", "");
-    });
+    }));
     
-    webServer.on("/on_off", [](){
+    webServer.on("/on_off", stats.wrap(ROUTE_ON_OFF_GET, [](){
         webServer.send(200, "text/plain", isOn ? "ON" : "OFF");
-    });
+    }));
 
-    webServer.on(UriRegex("^\\/on_off/(ON|OFF)"), [&](){
+    webServer.on(UriRegex("^\\/on_off/(ON|OFF)"), stats.wrap(ROUTE_ON_OFF_SET, [&](){
         String new_s = webServer.pathArg(0);
 
         if      ( new_s == "ON" ) isOn = true;
         else if (new_s == "OFF" ) isOn = false;
 
         webServer.send(200, "text/plain", "");
-    });
-
-    webServer.on("/send", [&](){
-        remote
-            .setStreamMode(stream_mode)
-            .setTemperature(temperature, temp_is_half);
-            
-        if(isOn){
-            remote.turnOn();
-        }
-        else{
-            remote.turnOff();
-        }
+    }));
 
-        remote.send();
+    webServer.on("/send", stats.wrap(ROUTE_SEND, [&](){
+        ir_pending = true;
         webServer.send(200, "text/plain", "Send...");
-    });
+    }));
+
+    webServer.on("/room_temperature", stats.wrap(ROUTE_ROOM_TEMPERATURE_GET, [](){
+        if(!roomSensor.hasReading(millis())){
+            webServer.send(503, "text/plain", roomSensor.isPresent() ? "No reading yet" : "No sensor");
+            return;
+        }
+
+        webServer.send(200, "text/plain", String(roomSensor.getTemperature(), 1));
+    }));
+
+    webServer.on("/thermostat", stats.wrap(ROUTE_THERMOSTAT_GET, [](){
+        String mode = thermostat.getMode() == ThermostatMode::HEAT ? "HEAT" : "COOL";
+
+        webServer.send(200, "text/plain", (thermostat.isEnabled() ? "ON " : "OFF ") + mode);
+    }));
+
+    // COOL/HEAT only selects how the room temperature drives the power switch,
+    // the frame still asks the unit for its AUTO operating mode
+    webServer.on(UriRegex("^\\/thermostat/(ON|OFF|COOL|HEAT)"), stats.wrap(ROUTE_THERMOSTAT_SET, [&](){
+        String new_t = webServer.pathArg(0);
+
+        if      ( new_t == "ON" )   thermostat.setEnabled(true);
+        else if ( new_t == "OFF" )  thermostat.setEnabled(false);
+        else if ( new_t == "COOL" ) thermostat.setMode(ThermostatMode::COOL);
+        else if ( new_t == "HEAT" ) thermostat.setMode(ThermostatMode::HEAT);
+
+        webServer.send(200, "text/plain", "");
+    }));
+
+    webServer.on("/stats", stats.wrap(ROUTE_STATS, [](){
+        webServer.send(200, "application/json", stats.toJSON());
+    }));
+
+    webServer.on("/trace", stats.wrap(ROUTE_TRACE, [](){
+        uint32_t buffer[TRACE_DUMP_WORDS];
+        size_t length = trace.dump(buffer);
+
+        webServer.send(200, "application/octet-stream", (const char*)buffer, length);
+    }));
+
+    webServer.on("/utilisation", stats.wrap(ROUTE_UTILISATION, [](){
+        webServer.send(200, "application/json",
+            "{\"busy_ms\":" + String((unsigned long)(scheduler.getBusy() / 1000)) +
+            ",\"idle_ms\":" + String((unsigned long)(scheduler.getIdle() / 1000)) +
+            ",\"utilisation\":" + String(scheduler.getUtilisation(), 4) +
+            ",\"idle_slice_max_us\":" + String(scheduler.getIdleSliceMax()) +
+            ",\"served_wait_bound_max_us\":" + String(scheduler.getServedWaitBoundMax()) +
+            ",\"max_sleep_ms\":" + String(scheduler.getMaxSleep()) + "}");
+    }));
+
+    webServer.on("/stats/reset", stats.wrap(ROUTE_STATS, [](){
+        stats.reset();
+        scheduler.reset();
+        webServer.send(200, "text/plain", "");
+    }));
+
+    webServer.onNotFound(stats.wrap(ROUTE_NOT_FOUND, [](){
+        webServer.send(404, "text/plain", "Not found");
+    }));
 
   webServer.begin();
   Serial.println("HTTP server started");
@@ -121,13 +203,87 @@ void configure_webserver(){
 
 void ap_loop(){
   settingServer.handleClient();
+  trace.checkHeap();
+}
+
+void thermostat_loop(){
+    unsigned long now = millis();
+
+    roomSensor.update(now);
+
+    if(!roomSensor.hasReading(now)){
+        return;
+    }
+
+    thermostat.setTarget(get_setpoint());
+
+    switch(thermostat.update(roomSensor.getTemperature(), now)){
+        case TURN_ON:
+            isOn = true;
+            ir_pending = true;
+            break;
+
+        case TURN_OFF:
+            isOn = false;
+            ir_pending = true;
+            break;
+
+        default:
+            break;
+    }
 }
 
 void main_loop(){
     webServer.handleClient();
+    thermostat_loop();
+
+    if(ir_pending){
+        ir_pending = false;
+        send_command();
+    }
+
+    traceWiFiStatus();
+    trace.checkHeap();
 }
 
+struct FirmwareLoop{
+    uint32_t micros(){ return ::micros(); }
+    unsigned long millis(){ return ::millis(); }
+
+    bool pollServers(){
+        uint32_t served = stats.getServed();
+
+        if(isAP){
+            ap_loop();
+            return stats.getServed() != served || settingServer.hasClient();
+        }
+
+        main_loop();
+        return stats.getServed() != served || webServer.client().connected();
+    }
+
+    void addDeadlines(IdleScheduler& s){
+        if(!isAP && roomSensor.isPresent()){
+            s.deadline(roomSensor.getNextEvent());
+        }
+    }
+
+    // delay() hands the CPU to the SDK, the radio stays in the default modem sleep
+    void idle(unsigned long ms){
+        if(ms > 0){
+            delay(ms);
+        }
+        else{
+            yield();
+        }
+    }
+};
+
+FirmwareLoop firmwareLoop;
+
 void setup(){
+    trace.init();
+
     pinMode(led_r, OUTPUT);
     pinMode(led_g, OUTPUT);
     pinMode(led_b, OUTPUT);
@@ -137,6 +293,7 @@ void setup(){
     set_blue(true);
 
     remote.init();
+    roomSensor.init();
     Serial.begin(115200);
 
     Serial.println("Wifi connection...");
@@ -157,6 +314,7 @@ void setup(){
         Serial.println("Connection fail !");
         Serial.println("Start AP Mode");
         isAP = true;
+        scheduler.setMaxSleep(IDLE_AP_MAX_SLEEP_MS);
         settingServer.startServer();
         set_blue(false);
         set_red(true);
@@ -164,10 +322,5 @@ void setup(){
 }
 
 void loop(){
-  if(isAP){
-    ap_loop();
-  }
-  else{
-    main_loop();
-  }
+  scheduler.step(firmwareLoop);
 }
\ No newline at end of file
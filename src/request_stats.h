@@ -0,0 +1,165 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <umm_malloc/umm_malloc.h>
+
+#include "trace.h"
+
+enum RouteId : uint8_t {
+    ROUTE_TEMPERATURE_GET,
+    ROUTE_TEMPERATURE_SET,
+    ROUTE_STREAM_MODE_GET,
+    ROUTE_STREAM_MODE_SET,
+    ROUTE_ON_OFF_GET,
+    ROUTE_ON_OFF_SET,
+    ROUTE_SEND,
+    ROUTE_ROOM_TEMPERATURE_GET,
+    ROUTE_THERMOSTAT_GET,
+    ROUTE_THERMOSTAT_SET,
+    ROUTE_STATS,
+    ROUTE_TRACE,
+    ROUTE_UTILISATION,
+    ROUTE_NOT_FOUND,
+    ROUTE_PORTAL_ROOT,
+    ROUTE_PORTAL_SETTINGS,
+    ROUTE_PORTAL_RESTART,
+    ROUTE_PORTAL_NOT_FOUND,
+    ROUTE_COUNT
+};
+
+const char * RouteToString(RouteId route){
+    switch (route)
+    {
+        case ROUTE_TEMPERATURE_GET:  return "temperature_get";
+        case ROUTE_TEMPERATURE_SET:  return "temperature_set";
+        case ROUTE_STREAM_MODE_GET:  return "stream_mode_get";
+        case ROUTE_STREAM_MODE_SET:  return "stream_mode_set";
+        case ROUTE_ON_OFF_GET:       return "on_off_get";
+        case ROUTE_ON_OFF_SET:       return "on_off_set";
+        case ROUTE_SEND:             return "send";
+        case ROUTE_ROOM_TEMPERATURE_GET: return "room_temperature_get";
+        case ROUTE_THERMOSTAT_GET:   return "thermostat_get";
+        case ROUTE_THERMOSTAT_SET:   return "thermostat_set";
+        case ROUTE_STATS:            return "stats";
+        case ROUTE_TRACE:            return "trace";
+        case ROUTE_UTILISATION:      return "utilisation";
+        case ROUTE_NOT_FOUND:        return "not_found";
+        case ROUTE_PORTAL_ROOT:      return "portal_root";
+        case ROUTE_PORTAL_SETTINGS:  return "portal_settings";
+        case ROUTE_PORTAL_RESTART:   return "portal_restart";
+        case ROUTE_PORTAL_NOT_FOUND: return "portal_not_found";
+
+        default:
+            return "unknown";
+    }
+}
+
+struct RouteStats{
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t max_us;
+    uint32_t heap_peak_max;     // Most heap in use at once by one request, from the umm low-water mark
+    uint32_t heap_free_min;     // Lowest free heap reached during a request
+    uint32_t mallocs;           // Allocations made by the handlers (UMM_STATS_FULL builds only)
+};
+
+/*
+ * Server side counters for the load benchmark (tools/http_bench.py).
+ * Handlers are wrapped so their execution time and heap usage are recorded
+ * without touching their body.
+ */
+class RequestStats{
+    public:
+        RequestStats() : served(0) {
+            reset();
+        }
+
+        void reset(){
+            for(size_t i = 0; i < ROUTE_COUNT; ++i){
+                routes[i] = {0, 0, 0, 0, UINT32_MAX, 0};
+            }
+            started_ms = millis();
+        }
+
+        std::function<void()> wrap(RouteId route, std::function<void()> handler){
+            return [this, route, handler](){
+                // The low-water mark restarts from the current free heap
+                uint32_t heap_before = umm_free_heap_size_min_reset();
+                uint32_t mallocs_before = mallocCount();
+                uint32_t start = micros();
+                trace.record(TRACE_HTTP_START, route);
+
+                handler();
+
+                uint32_t elapsed = micros() - start;
+                trace.record(TRACE_HTTP_END, route, elapsed / 1000 > UINT16_MAX ? UINT16_MAX : uint16_t(elapsed / 1000));
+                record(route, elapsed, heap_before, umm_free_heap_size_min(), mallocCount() - mallocs_before);
+            };
+        }
+
+        void record(RouteId route, uint32_t elapsed_us, uint32_t heap_before, uint32_t heap_low, uint32_t mallocs){
+            if(route >= ROUTE_COUNT){
+                return;
+            }
+
+            served++;
+
+            RouteStats& s = routes[route];
+            uint32_t heap_peak = heap_before > heap_low ? heap_before - heap_low : 0;
+
+            s.count++;
+            s.total_us += elapsed_us;
+            s.mallocs += mallocs;
+            if(elapsed_us > s.max_us) s.max_us = elapsed_us;
+            if(heap_peak > s.heap_peak_max) s.heap_peak_max = heap_peak;
+            if(heap_low < s.heap_free_min) s.heap_free_min = heap_low;
+        }
+
+        // Requests handled since boot, not cleared by reset()
+        uint32_t getServed(){ return served; }
+
+        String toJSON(){
+            String result = "{\"uptime_ms\":" + String(millis()) +
+                            ",\"window_ms\":" + String(millis() - started_ms) +
+                            ",\"heap_free\":" + String(ESP.getFreeHeap()) +
+                            ",\"routes\":{";
+
+            bool first = true;
+            for(size_t i = 0; i < ROUTE_COUNT; ++i){
+                const RouteStats& s = routes[i];
+
+                if(s.count == 0) continue;
+                if(!first) result += ",";
+                first = false;
+
+                result += "\"" + String(RouteToString(RouteId(i))) + "\":{"
+                          "\"count\":" + String(s.count) +
+                          ",\"total_us\":" + String(s.total_us) +
+                          ",\"max_us\":" + String(s.max_us) +
+                          ",\"heap_peak_max\":" + String(s.heap_peak_max) +
+                          ",\"heap_free_min\":" + String(s.heap_free_min) +
+#ifdef UMM_STATS_FULL
+                          ",\"mallocs\":" + String(s.mallocs) +
+#endif
+                          "}";
+            }
+
+            result += "}}";
+            return result;
+        }
+
+    private:
+        RouteStats routes[ROUTE_COUNT];
+
+        static uint32_t mallocCount(){
+#ifdef UMM_STATS_FULL
+            return umm_get_malloc_count();
+#else
+            return 0;
+#endif
+        }
+
+        unsigned long started_ms;
+        uint32_t served;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+constexpr unsigned long ROOM_SENSOR_CONVERSION_TIME = 750;     // 12 bits resolution
+constexpr unsigned long ROOM_SENSOR_PERIOD = 10000;
+constexpr unsigned long ROOM_SENSOR_STALE_TIME = 3 * ROOM_SENSOR_PERIOD;
+
+// Scratchpad value of a DS18B20 after power on, read back after a brown-out
+constexpr float ROOM_SENSOR_POWER_ON_VALUE = 85.0;
+constexpr float ROOM_SENSOR_POWER_ON_MARGIN = 2.0;
+
+enum RoomSensorState{
+    SENSOR_IDLE,
+    SENSOR_CONVERTING
+};
+
+/*
+ * DS18B20 room sensor sampled without blocking: update() starts a conversion,
+ * then collects it on a later call once the conversion time has elapsed.
+ */
+class RoomSensor{
+    public:
+        RoomSensor(byte pin) : oneWire(pin), sensors(&oneWire),
+        state(SENSOR_IDLE), present(false), valid(false), temperature(NAN),
+        last_reading(0), next_event(0)
+        {}
+
+        void init(){
+            sensors.begin();
+            sensors.setResolution(12);
+            sensors.setWaitForConversion(false);
+
+            // Searching the bus on every sample would keep interrupts off for long
+            present = sensors.getAddress(address, 0);
+        }
+
+        void update(unsigned long now){
+            if(!present || (long)(now - next_event) < 0){
+                return;
+            }
+
+            switch(state){
+                case SENSOR_IDLE:
+                    sensors.requestTemperaturesByAddress(address);
+                    state = SENSOR_CONVERTING;
+                    next_event = now + ROOM_SENSOR_CONVERSION_TIME;
+                    break;
+
+                case SENSOR_CONVERTING:{
+                    float t = sensors.getTempC(address);
+
+                    if(t != DEVICE_DISCONNECTED_C && !isPowerOnValue(t)){
+                        temperature = t;
+                        last_reading = now;
+                        valid = true;
+                    }
+
+                    state = SENSOR_IDLE;
+                    next_event = now + ROOM_SENSOR_PERIOD - ROOM_SENSOR_CONVERSION_TIME;
+                    break;
+                }
+            }
+        }
+
+        bool isPresent(){ return present; }
+
+        bool hasReading(unsigned long now){
+            return valid && (now - last_reading) < ROOM_SENSOR_STALE_TIME;
+        }
+
+        float getTemperature(){ return temperature; }
+        unsigned long getLastReading(){ return last_reading; }
+        unsigned long getNextEvent(){ return next_event; }
+
+    private:
+        OneWire oneWire;
+        DallasTemperature sensors;
+        DeviceAddress address;
+
+        RoomSensorState state;
+        bool present;
+        bool valid;
+        float temperature;
+        unsigned long last_reading;
+        unsigned long next_event;
+
+        // 85 C is only trusted when the room was already close to it
+        bool isPowerOnValue(float t){
+            return t == ROOM_SENSOR_POWER_ON_VALUE &&
+                   !(valid && fabsf(temperature - ROOM_SENSOR_POWER_ON_VALUE) <= ROOM_SENSOR_POWER_ON_MARGIN);
+        }
+};
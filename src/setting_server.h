@@ -5,6 +5,7 @@
 
 #include "eeprom_settings.h"
 #include "utils.h"
+#include "request_stats.h"
 
 struct WiFi_Network{
   String ssid;
@@ -15,8 +16,8 @@ struct WiFi_Network{
 class SettingServer {
 
     public:
-        SettingServer(const char* ssid, EEPROM_Settings& settings) : 
-        settings(settings), ipAP(8, 8, 8, 8), netMsk(255, 255, 255, 0),
+        SettingServer(const char* ssid, EEPROM_Settings& settings, RequestStats& stats) : 
+        settings(settings), stats(stats), ipAP(8, 8, 8, 8), netMsk(255, 255, 255, 0),
         ssidAP(ssid),
         askForRestart(false)
         {}
@@ -35,10 +36,13 @@ class SettingServer {
 
             dnsServer->start(53, "*", ipAP);
 
-            webServer->on("/", std::bind(&SettingServer::handleRoot, this));
-            webServer->on("/setSettings", std::bind(&SettingServer::handleSettings, this));
-            webServer->on("/restart", std::bind(&SettingServer::handleRestart, this));
-            webServer->onNotFound(std::bind(&SettingServer::handleNotFound, this));
+            webServer->on("/", stats.wrap(ROUTE_PORTAL_ROOT, std::bind(&SettingServer::handleRoot, this)));
+            webServer->on("/setSettings", stats.wrap(ROUTE_PORTAL_SETTINGS, std::bind(&SettingServer::handleSettings, this)));
+            webServer->on("/restart", stats.wrap(ROUTE_PORTAL_RESTART, std::bind(&SettingServer::handleRestart, this)));
+            webServer->on("/stats", stats.wrap(ROUTE_STATS, std::bind(&SettingServer::handleStats, this)));
+            webServer->on("/stats/reset", stats.wrap(ROUTE_STATS, std::bind(&SettingServer::handleStatsReset, this)));
+            webServer->on("/trace", stats.wrap(ROUTE_TRACE, std::bind(&SettingServer::handleTrace, this)));
+            webServer->onNotFound(stats.wrap(ROUTE_PORTAL_NOT_FOUND, std::bind(&SettingServer::handleNotFound, this)));
             webServer->begin(); 
         }
 
@@ -47,8 +51,14 @@ class SettingServer {
             webServer->handleClient();
         }
 
+        // A client accepted by handleClient() may still wait to be parsed
+        bool hasClient(){
+            return webServer->client().connected();
+        }
+
     private:
         EEPROM_Settings& settings;
+        RequestStats& stats;
         ESP8266WebServer *webServer;
         DNSServer *dnsServer;
         
@@ -178,6 +188,22 @@ class SettingServer {
             webServer->send(404, "text/html", page);
         }
 
+        void handleStats(){
+            webServer->send(200, "application/json", stats.toJSON());
+        }
+
+        void handleStatsReset(){
+            stats.reset();
+            webServer->send(200, "text/plain", "");
+        }
+
+        void handleTrace(){
+            uint32_t buffer[TRACE_DUMP_WORDS];
+            size_t length = trace.dump(buffer);
+
+            webServer->send(200, "application/octet-stream", (const char*)buffer, length);
+        }
+
         void handleRestart(){
             if(captivePortalRedirect()){return;}
             
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+constexpr float THERMOSTAT_HYSTERESIS = 0.5;
+constexpr unsigned long THERMOSTAT_MIN_DWELL = 5UL * 60UL * 1000UL;
+
+enum ThermostatMode{
+    COOL,
+    HEAT
+};
+
+enum ThermostatAction{
+    NO_ACTION,
+    TURN_ON,
+    TURN_OFF
+};
+
+/*
+ * On/off room controller. The air conditioner is switched when the room
+ * leaves the [target - hysteresis, target + hysteresis] band, and never
+ * sooner than min_dwell after the previous switch, so IR traffic stays low.
+ */
+class Thermostat{
+    public:
+        Thermostat(float hysteresis = THERMOSTAT_HYSTERESIS, unsigned long min_dwell = THERMOSTAT_MIN_DWELL) :
+        hysteresis(hysteresis), min_dwell(min_dwell),
+        enabled(false), mode(ThermostatMode::COOL), target(16),
+        is_on(false), has_switched(false), last_switch(0)
+        {}
+
+        void setEnabled(bool enable){ enabled = enable; }
+        bool isEnabled(){ return enabled; }
+
+        void setMode(ThermostatMode new_mode){ mode = new_mode; }
+        ThermostatMode getMode(){ return mode; }
+
+        void setTarget(float new_target){ target = new_target; }
+        float getTarget(){ return target; }
+
+        // Keep track of manual commands so the dwell time also covers them
+        void notifyPower(bool on, unsigned long now){
+            if(on != is_on){
+                is_on = on;
+                has_switched = true;
+                last_switch = now;
+            }
+        }
+
+        ThermostatAction update(float room, unsigned long now){
+            if(!enabled){
+                return ThermostatAction::NO_ACTION;
+            }
+
+            if(has_switched && (now - last_switch) < min_dwell){
+                return ThermostatAction::NO_ACTION;
+            }
+
+            bool too_hot = room >= target + hysteresis;
+            bool too_cold = room <= target - hysteresis;
+            bool want_on = is_on;
+
+            if(mode == ThermostatMode::COOL){
+                if(too_hot)  want_on = true;
+                if(too_cold) want_on = false;
+            }
+            else{
+                if(too_cold) want_on = true;
+                if(too_hot)  want_on = false;
+            }
+
+            if(want_on == is_on){
+                return ThermostatAction::NO_ACTION;
+            }
+
+            notifyPower(want_on, now);
+            return want_on ? ThermostatAction::TURN_ON : ThermostatAction::TURN_OFF;
+        }
+
+    private:
+        float hysteresis;
+        unsigned long min_dwell;
+
+        bool enabled;
+        ThermostatMode mode;
+        float target;
+
+        bool is_on;
+        bool has_switched;
+        unsigned long last_switch;
+};
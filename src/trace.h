@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The first 128 bytes of the RTC user memory are used by the OTA updater
+constexpr uint32_t TRACE_RTC_OFFSET = 32;       // In 4 bytes blocks
+constexpr uint32_t TRACE_MAGIC = 0x31435254;    // "TRC1"
+constexpr uint32_t TRACE_CAPACITY = 47;         // 8 bytes header + 47 * 8 bytes records = 384 bytes
+constexpr uint32_t TRACE_HEAP_STEP = 512;
+
+enum TraceEvent : uint8_t {
+    TRACE_BOOT,             // arg: reset reason
+    TRACE_HTTP_START,       // arg: route id
+    TRACE_HTTP_END,         // arg: route id, value: duration (ms)
+    TRACE_IR_START,
+    TRACE_IR_END,           // value: duration (ms)
+    TRACE_WIFI_STATUS,      // arg: wl_status_t
+    TRACE_EEPROM_COMMIT,    // arg: EEPROM address
+    TRACE_HEAP_LOW          // value: free heap (bytes)
+};
+
+struct TraceRecord{
+    uint32_t timestamp;     // millis()
+    uint8_t event;
+    uint8_t arg;
+    uint16_t value;
+};
+
+static_assert(sizeof(TraceRecord) == 8, "TraceRecord must fit in two RTC blocks");
+
+constexpr size_t TRACE_DUMP_WORDS = 3 + 2 * TRACE_CAPACITY;
+
+/*
+ * Fixed size event trace kept in RTC memory, so the events that led to a
+ * watchdog or exception reset can be read back after the reboot on /trace.
+ * Decode the dump with tools/trace_decode.py.
+ */
+class Trace{
+    public:
+        Trace() : count(0), heap_low(UINT32_MAX), ready(false) {}
+
+        void init(){
+            uint32_t header[2];
+            ESP.rtcUserMemoryRead(TRACE_RTC_OFFSET, header, sizeof(header));
+
+            // Power on leaves random data in RTC memory
+            if(header[0] != TRACE_MAGIC){
+                header[0] = TRACE_MAGIC;
+                header[1] = 0;
+                ESP.rtcUserMemoryWrite(TRACE_RTC_OFFSET, header, sizeof(header));
+            }
+
+            count = header[1];
+            ready = true;
+
+            record(TRACE_BOOT, uint8_t(ESP.getResetInfoPtr()->reason));
+        }
+
+        void record(TraceEvent event, uint8_t arg = 0, uint16_t value = 0){
+            if(!ready){
+                return;
+            }
+
+            TraceRecord r = {millis(), event, arg, value};
+            uint32_t slot = TRACE_RTC_OFFSET + 2 + 2 * (count % TRACE_CAPACITY);
+
+            ESP.rtcUserMemoryWrite(slot, (uint32_t*)&r, sizeof(r));
+
+            count++;
+            ESP.rtcUserMemoryWrite(TRACE_RTC_OFFSET + 1, &count, sizeof(count));
+        }
+
+        void checkHeap(){
+            uint32_t free_heap = ESP.getFreeHeap();
+
+            if(free_heap + TRACE_HEAP_STEP <= heap_low){
+                heap_low = free_heap;
+                record(TRACE_HEAP_LOW, 0, free_heap > UINT16_MAX ? UINT16_MAX : uint16_t(free_heap));
+            }
+        }
+
+        /*
+         * Dump layout (little endian): magic, total record count, capacity,
+         * then the kept records from the oldest to the newest.
+         */
+        size_t dump(uint32_t (&buffer)[TRACE_DUMP_WORDS]){
+            uint32_t kept = count < TRACE_CAPACITY ? count : TRACE_CAPACITY;
+
+            buffer[0] = TRACE_MAGIC;
+            buffer[1] = count;
+            buffer[2] = TRACE_CAPACITY;
+
+            uint32_t* out = buffer + 3;
+            for(uint32_t i = count - kept; i != count; ++i){
+                uint32_t slot = TRACE_RTC_OFFSET + 2 + 2 * (i % TRACE_CAPACITY);
+                ESP.rtcUserMemoryRead(slot, out, sizeof(TraceRecord));
+                out += 2;
+            }
+
+            return (3 + 2 * kept) * sizeof(uint32_t);
+        }
+
+    private:
+        uint32_t count;
+        uint32_t heap_low;
+        bool ready;
+};
+
+// Shared by every module, like the helpers of utils.h
+Trace trace;
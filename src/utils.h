@@ -4,6 +4,8 @@
 #include <ESP8266WiFi.h>
 #include <vector>
 
+#include "trace.h"
+
 
 
 const char * StatusToString(wl_status_t status){
@@ -39,6 +41,17 @@ const char * StatusToString(wl_status_t status){
   }
 }
 
+wl_status_t lastWiFiStatus = WL_NO_SHIELD;
+
+void traceWiFiStatus(){
+    wl_status_t status = WiFi.status();
+
+    if(status != lastWiFiStatus){
+        lastWiFiStatus = status;
+        trace.record(TRACE_WIFI_STATUS, uint8_t(status));
+    }
+}
+
 bool tryConnectWiFi(const char* ssid, const char* pass, unsigned long timeout = 10000){
     WiFi.mode(WiFiMode::WIFI_STA);
     WiFi.begin(ssid, pass);
@@ -46,9 +59,12 @@ bool tryConnectWiFi(const char* ssid, const char* pass, unsigned long timeout =
     unsigned long start = millis();
 
     while( WiFi.status() != WL_CONNECTED && (millis() - start) < timeout){
+        traceWiFiStatus();
         delay(250);
     }
 
+    traceWiFiStatus();
+
     Serial.println(StatusToString(WiFi.status()));
 
     return (WiFi.status() == WL_CONNECTED);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if(!(cond)){ \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while(0)
+
+// Exit code of the test program
+static int report(const char* suite){
+    if(failures > 0){
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All %s tests passed\n", suite);
+    return 0;
+}
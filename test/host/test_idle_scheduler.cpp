@@ -0,0 +1,204 @@
+#include <vector>
+
+#include "check.h"
+#include "idle_scheduler.h"
+
+// Longest accepted wait of an incoming command, set with -DIDLE_WAKE_BOUND_MS
+#ifndef IDLE_WAKE_BOUND_MS
+#define IDLE_WAKE_BOUND_MS (IDLE_MAX_SLEEP_MS + 5)
+#endif
+
+constexpr uint32_t LOOP_BUSY_US = 400;          // handleClient() and the other subsystems
+constexpr uint32_t IR_FRAME_US = 350000;        // PanasonicRemote::send() busy wait
+constexpr uint32_t DELAY_OVERRUN_US = 300;      // delay() returns a bit late
+constexpr uint32_t YIELD_US = 50;
+
+struct Random{
+    uint32_t state;
+
+    uint32_t next(uint32_t bound){
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) % bound;
+    }
+};
+
+struct Command{
+    uint64_t arrival_us;
+    bool sends_ir;
+    bool late_bytes;        // Accepted by one handleClient() call, parsed by the next one
+};
+
+/*
+ * Stand-in for FirmwareLoop of main.cpp on a fake clock. Like
+ * ESP8266WebServer, pollServers() takes at most one client per call.
+ */
+struct FakeLoop{
+    uint64_t clock_us;
+    std::vector<Command> commands;
+    size_t next;
+    bool holding;
+    unsigned long sensor_period_ms;
+    unsigned long sensor_next;
+    unsigned long max_sleep;
+    uint64_t longest_wait;
+
+    FakeLoop(uint64_t start_us, const std::vector<Command>& commands, unsigned long max_sleep,
+             unsigned long sensor_period_ms = 0) :
+    clock_us(start_us), commands(commands), next(0), holding(false),
+    sensor_period_ms(sensor_period_ms), sensor_next(millis() + sensor_period_ms),
+    max_sleep(max_sleep), longest_wait(0)
+    {}
+
+    uint32_t micros(){ return uint32_t(clock_us); }
+    unsigned long millis(){ return (unsigned long)(uint32_t(clock_us / 1000)); }
+
+    bool pollServers(){
+        clock_us += LOOP_BUSY_US;
+
+        if(next >= commands.size() || clock_us < commands[next].arrival_us){
+            return false;
+        }
+
+        Command& command = commands[next];
+
+        if(command.late_bytes && !holding){
+            holding = true;
+            return true;
+        }
+
+        uint64_t wait = clock_us - command.arrival_us;
+        if(wait > longest_wait) longest_wait = wait;
+
+        if(command.sends_ir) clock_us += IR_FRAME_US;
+
+        holding = false;
+        next++;
+        return true;
+    }
+
+    void addDeadlines(IdleScheduler& scheduler){
+        if(sensor_period_ms == 0){
+            return;
+        }
+
+        unsigned long now = millis();
+        if((long)(now - sensor_next) >= 0) sensor_next = now + sensor_period_ms;
+        scheduler.deadline(sensor_next);
+    }
+
+    void idle(unsigned long ms){
+        CHECK(ms <= max_sleep);
+        clock_us += ms > 0 ? ms * 1000 + DELAY_OVERRUN_US : YIELD_US;
+    }
+
+    bool done(){ return next >= commands.size(); }
+};
+
+static uint64_t run(IdleScheduler& scheduler, FakeLoop& loop){
+    while(!loop.done()){
+        scheduler.step(loop);
+    }
+
+    return loop.longest_wait;
+}
+
+static std::vector<Command> random_commands(Random& random, uint64_t start_us, size_t count,
+                                            uint32_t min_gap_us, uint32_t max_gap_us){
+    std::vector<Command> commands;
+    uint64_t at = start_us;
+
+    for(size_t i = 0; i < count; ++i){
+        at += min_gap_us + random.next(max_gap_us - min_gap_us);
+        commands.push_back({at, false, random.next(4) == 0});
+    }
+
+    return commands;
+}
+
+static void test_sleep_time(){
+    IdleScheduler scheduler(50);
+
+    scheduler.begin(1000);
+    CHECK(scheduler.sleepTime(1000) == 50);
+
+    scheduler.begin(1000);
+    scheduler.deadline(1020);
+    scheduler.deadline(1080);
+    CHECK(scheduler.sleepTime(1000) == 20);
+
+    scheduler.begin(1000);
+    scheduler.deadline(990);
+    CHECK(scheduler.sleepTime(1000) == 0);
+
+    // millis() wraps after 49 days
+    unsigned long now = 0xFFFFFFF0UL;
+    scheduler.begin(now);
+    scheduler.deadline(now + 30);
+    CHECK(scheduler.sleepTime(now) == 30);
+}
+
+// Dashboard pace: one command at a time, 0.1 to 1 s apart
+static void test_wait_stays_under_bound(){
+    for(uint64_t start_us : {uint64_t(0), uint64_t(0xFFF00000u)}){     // Also across the micros() wrap
+        Random random{uint32_t(start_us) + 7};
+        IdleScheduler scheduler(IDLE_MAX_SLEEP_MS);
+        FakeLoop loop(start_us, random_commands(random, start_us, 500, 100000, 1000000), IDLE_MAX_SLEEP_MS, 10000);
+
+        uint64_t longest_wait = run(scheduler, loop);
+
+        CHECK(longest_wait <= scheduler.getServedWaitBoundMax());
+        CHECK(scheduler.getServedWaitBoundMax() <= IDLE_WAKE_BOUND_MS * 1000UL);
+        CHECK(scheduler.getIdleSliceMax() <= IDLE_MAX_SLEEP_MS * 1000UL + DELAY_OVERRUN_US);
+    }
+}
+
+// Commands closer than a poll queue up, they are served back to back
+static void test_bursts_stay_under_bound(){
+    Random random{3};
+    IdleScheduler scheduler(IDLE_MAX_SLEEP_MS);
+    FakeLoop loop(0, random_commands(random, 0, 500, 1000, 60000), IDLE_MAX_SLEEP_MS);
+
+    uint64_t longest_wait = run(scheduler, loop);
+
+    CHECK(longest_wait <= scheduler.getServedWaitBoundMax());
+    CHECK(scheduler.getServedWaitBoundMax() <= IDLE_WAKE_BOUND_MS * 1000UL);
+}
+
+static void test_ir_frame_is_reported(){
+    Random random{42};
+    IdleScheduler scheduler(IDLE_MAX_SLEEP_MS);
+
+    // A command right behind one that sends an IR frame waits for the frame
+    std::vector<Command> commands = random_commands(random, 10000, 50, 100000, 1000000);
+    commands.insert(commands.begin(), {{1000, true, false}, {2000, false, false}});
+
+    FakeLoop loop(0, commands, IDLE_MAX_SLEEP_MS);
+    uint64_t longest_wait = run(scheduler, loop);
+
+    CHECK(longest_wait >= IR_FRAME_US);
+    CHECK(longest_wait <= scheduler.getServedWaitBoundMax());
+    CHECK(scheduler.getServedWaitBoundMax() > IDLE_WAKE_BOUND_MS * 1000UL);
+}
+
+static void test_utilisation(){
+    IdleScheduler scheduler;
+    CHECK(scheduler.getUtilisation() == 0);
+
+    scheduler.addBusy(250);
+    scheduler.addIdle(750);
+    CHECK(scheduler.getUtilisation() > 0.249f && scheduler.getUtilisation() < 0.251f);
+
+    scheduler.reset();
+    CHECK(scheduler.getBusy() == 0 && scheduler.getIdle() == 0);
+    CHECK(scheduler.getIdleSliceMax() == 0 && scheduler.getServedWaitBoundMax() == 0);
+}
+
+int main(){
+    test_sleep_time();
+    test_wait_stays_under_bound();
+    test_bursts_stay_under_bound();
+    test_ir_frame_is_reported();
+    test_utilisation();
+
+    return report("idle scheduler");
+}
@@ -0,0 +1,191 @@
+#include <vector>
+
+#include "check.h"
+#include "thermostat.h"
+
+constexpr unsigned long MINUTE = 60UL * 1000UL;
+constexpr unsigned long SAMPLE_PERIOD = 10000;      // Same as ROOM_SENSOR_PERIOD
+
+/*
+ * First order room: the temperature relaxes toward the outside with time
+ * constant tau, and the unit adds (heat) or removes (cool) power while on.
+ */
+struct Room{
+    float temperature;
+    float outside;
+    float tau_s;
+    float unit_rate;        // Degrees per second while the unit is on
+
+    void step(bool unit_on, ThermostatMode mode, float dt_s){
+        float rate = (outside - temperature) / tau_s;
+
+        if(unit_on){
+            rate += mode == ThermostatMode::COOL ? -unit_rate : unit_rate;
+        }
+
+        temperature += rate * dt_s;
+    }
+};
+
+struct Switch{
+    unsigned long at;
+    ThermostatAction action;
+    float room;
+};
+
+static std::vector<Switch> simulate(Thermostat& thermostat, Room& room, unsigned long duration){
+    std::vector<Switch> switches;
+    bool unit_on = false;
+
+    for(unsigned long now = 0; now < duration; now += SAMPLE_PERIOD){
+        ThermostatAction action = thermostat.update(room.temperature, now);
+
+        if(action != ThermostatAction::NO_ACTION){
+            unit_on = action == ThermostatAction::TURN_ON;
+            switches.push_back({now, action, room.temperature});
+        }
+
+        room.step(unit_on, thermostat.getMode(), SAMPLE_PERIOD / 1000.0f);
+    }
+
+    return switches;
+}
+
+static void test_disabled_does_nothing(){
+    Thermostat thermostat;
+    thermostat.setTarget(24);
+
+    CHECK(thermostat.update(35, 0) == ThermostatAction::NO_ACTION);
+    CHECK(thermostat.update(10, 10 * MINUTE) == ThermostatAction::NO_ACTION);
+}
+
+static void test_no_switch_inside_band(){
+    for(ThermostatMode mode : {ThermostatMode::COOL, ThermostatMode::HEAT}){
+        for(bool initially_on : {false, true}){
+            Thermostat thermostat;
+            thermostat.setEnabled(true);
+            thermostat.setMode(mode);
+            thermostat.setTarget(24);
+            thermostat.notifyPower(initially_on, 0);
+
+            unsigned long now = THERMOSTAT_MIN_DWELL;
+            for(float t = 23.55f; t < 24.5f; t += 0.05f, now += SAMPLE_PERIOD){
+                CHECK(thermostat.update(t, now) == ThermostatAction::NO_ACTION);
+            }
+            for(float t = 24.45f; t > 23.5f; t -= 0.05f, now += SAMPLE_PERIOD){
+                CHECK(thermostat.update(t, now) == ThermostatAction::NO_ACTION);
+            }
+        }
+    }
+}
+
+static void test_polarity(){
+    Thermostat cool;
+    cool.setEnabled(true);
+    cool.setMode(ThermostatMode::COOL);
+    cool.setTarget(24);
+
+    CHECK(cool.update(23.0f, 0) == ThermostatAction::NO_ACTION);
+    CHECK(cool.update(25.0f, 0) == ThermostatAction::TURN_ON);
+    CHECK(cool.update(23.0f, THERMOSTAT_MIN_DWELL) == ThermostatAction::TURN_OFF);
+
+    Thermostat heat;
+    heat.setEnabled(true);
+    heat.setMode(ThermostatMode::HEAT);
+    heat.setTarget(20);
+
+    CHECK(heat.update(21.0f, 0) == ThermostatAction::NO_ACTION);
+    CHECK(heat.update(19.0f, 0) == ThermostatAction::TURN_ON);
+    CHECK(heat.update(21.0f, THERMOSTAT_MIN_DWELL) == ThermostatAction::TURN_OFF);
+}
+
+static void test_dwell_after_manual_command(){
+    Thermostat thermostat;
+    thermostat.setEnabled(true);
+    thermostat.setMode(ThermostatMode::COOL);
+    thermostat.setTarget(24);
+
+    // Unit switched on by hand through /send, while the room is already cold
+    unsigned long manual = 2 * MINUTE;
+    thermostat.notifyPower(true, manual);
+
+    for(unsigned long now = manual; now < manual + THERMOSTAT_MIN_DWELL; now += SAMPLE_PERIOD){
+        CHECK(thermostat.update(20.0f, now) == ThermostatAction::NO_ACTION);
+    }
+
+    CHECK(thermostat.update(20.0f, manual + THERMOSTAT_MIN_DWELL) == ThermostatAction::TURN_OFF);
+}
+
+// The unit is sized at about twice the heat leak at the target
+static void test_closed_loop(ThermostatMode mode, float outside, float target, float tau_s, float unit_rate){
+    Thermostat thermostat;
+    thermostat.setEnabled(true);
+    thermostat.setMode(mode);
+    thermostat.setTarget(target);
+
+    Room room{outside, outside, tau_s, unit_rate};
+    std::vector<Switch> switches = simulate(thermostat, room, 8 * 60 * MINUTE);
+
+    CHECK(switches.size() >= 4);
+
+    for(size_t i = 0; i < switches.size(); ++i){
+        const Switch& s = switches[i];
+        bool heating_demand = s.room <= target - THERMOSTAT_HYSTERESIS;
+        bool cooling_demand = s.room >= target + THERMOSTAT_HYSTERESIS;
+
+        // Every switch happens outside the band, in the direction of the mode
+        if(mode == ThermostatMode::COOL){
+            CHECK(s.action == ThermostatAction::TURN_ON ? cooling_demand : heating_demand);
+        }
+        else{
+            CHECK(s.action == ThermostatAction::TURN_ON ? heating_demand : cooling_demand);
+        }
+
+        if(i > 0){
+            CHECK(s.at - switches[i - 1].at >= THERMOSTAT_MIN_DWELL);
+        }
+    }
+
+    // Once settled, the room stays around the target
+    float min_t = 100, max_t = -100;
+    bool unit_on = switches.back().action == ThermostatAction::TURN_ON;
+    for(unsigned long now = 0; now < 2 * 60 * MINUTE; now += SAMPLE_PERIOD){
+        ThermostatAction action = thermostat.update(room.temperature, 8 * 60 * MINUTE + now);
+        if(action != ThermostatAction::NO_ACTION) unit_on = action == ThermostatAction::TURN_ON;
+
+        room.step(unit_on, mode, SAMPLE_PERIOD / 1000.0f);
+        if(room.temperature < min_t) min_t = room.temperature;
+        if(room.temperature > max_t) max_t = room.temperature;
+    }
+
+    CHECK(min_t > target - 2 * THERMOSTAT_HYSTERESIS);
+    CHECK(max_t < target + 2 * THERMOSTAT_HYSTERESIS);
+}
+
+static void test_dwell_limits_fast_room(){
+    Thermostat thermostat;
+    thermostat.setEnabled(true);
+    thermostat.setMode(ThermostatMode::COOL);
+    thermostat.setTarget(24);
+
+    // Oversized unit: the room crosses the band much faster than the dwell time
+    Room room{30, 30, 600.0f, 0.05f};
+    std::vector<Switch> switches = simulate(thermostat, room, 4 * 60 * MINUTE);
+
+    CHECK(switches.size() >= 2);
+    for(size_t i = 1; i < switches.size(); ++i){
+        CHECK(switches[i].at - switches[i - 1].at >= THERMOSTAT_MIN_DWELL);
+    }
+}
+
+int main(){
+    test_disabled_does_nothing();
+    test_no_switch_inside_band();
+    test_polarity();
+    test_dwell_after_manual_command();
+    test_closed_loop(ThermostatMode::COOL, 32, 24, 3600.0f, 0.0045f);
+    test_closed_loop(ThermostatMode::HEAT, 5, 20, 7200.0f, 0.0042f);
+    test_dwell_limits_fast_room();
+
+    return report("thermostat");
+}
@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+"""
+HTTP load generator for the control server (main.cpp) and the setup portal
+(SettingServer).
+
+Replays a realistic request mix against a running device, measures client
+side latency and throughput, then reads the firmware counters exposed on
+/stats to report handler time and heap usage per route.
+
+Client side latencies are end to end over Wi-Fi: they include radio jitter
+and up to one idle slice of the main loop (IDLE_MAX_SLEEP_MS), so they only
+compare runs made on the same network. The handler times and heap figures
+from /stats are measured on the device and do not depend on the network.
+Allocation counts need a firmware built with -DUMM_STATS_FULL.
+
+The "commands" and "control" mixes call /send, which makes the device emit
+real IR frames to the air conditioner at benchmark rate. They only run with
+--allow-ir.
+
+Examples:
+    tools/http_bench.py --host 192.168.1.42 --mix dashboard --duration 30
+    tools/http_bench.py --host 192.168.1.42 --mix control --allow-ir
+    tools/http_bench.py --host 8.8.8.8 --mix portal -o portal_v2.json
+    tools/http_bench.py --compare portal_v1.json portal_v2.json
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import http.client
+import json
+import random
+import sys
+import threading
+import time
+
+# Each scenario is a list of (label, path) requests played back to back.
+SCENARIOS = {
+    "dashboard_poll": [
+        ("temperature_get", "/temperature"),
+        ("stream_mode_get", "/stream_mode"),
+        ("on_off_get", "/on_off"),
+        ("room_temperature_get", "/room_temperature"),
+    ],
+    "command_burst": [
+        ("on_off_set", "/on_off/ON"),
+        ("temperature_set", "/temperature/22.5"),
+        ("stream_mode_set", "/stream_mode/QUIET"),
+        ("send", "/send"),
+    ],
+    "portal_page_load": [
+        ("portal_root", "/"),
+        ("portal_not_found", "/generate_204"),
+    ],
+}
+
+# Server errors that are normal answers of a route. /room_temperature answers
+# 503 on a board without room sensor, or before its first reading.
+EXPECTED_ERRORS = {
+    "room_temperature_get": {503},
+}
+
+# Weights of each scenario in a mix.
+MIXES = {
+    "dashboard": {"dashboard_poll": 1},
+    "commands": {"command_burst": 1},
+    "control": {"dashboard_poll": 8, "command_burst": 2},
+    "portal": {"portal_page_load": 1},
+}
+
+
+def uses_ir(scenario):
+    return any(path == "/send" for _, path in SCENARIOS[scenario])
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return None
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def request(host, port, path, timeout):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request("GET", path)
+        response = conn.getresponse()
+        body = response.read()
+        return response.status, body
+    finally:
+        conn.close()
+
+
+class Worker(threading.Thread):
+    def __init__(self, args, scenarios, weights, deadline, seed):
+        super().__init__(daemon=True)
+        self.args = args
+        self.scenarios = scenarios
+        self.weights = weights
+        self.deadline = deadline
+        self.random = random.Random(seed)
+        self.samples = {}
+        self.errors = 0
+
+    def run(self):
+        while time.monotonic() < self.deadline:
+            name = self.random.choices(self.scenarios, self.weights)[0]
+
+            for label, path in SCENARIOS[name]:
+                start = time.perf_counter()
+                try:
+                    status, _ = request(self.args.host, self.args.port, path, self.args.timeout)
+                    ok = status < 500 or status in EXPECTED_ERRORS.get(label, ())
+                except (OSError, http.client.HTTPException):
+                    ok = False
+                elapsed_us = (time.perf_counter() - start) * 1e6
+
+                if ok:
+                    self.samples.setdefault(label, []).append(elapsed_us)
+                else:
+                    self.errors += 1
+
+                if self.args.think_ms > 0:
+                    time.sleep(self.args.think_ms / 1000.0)
+
+
+def latency_summary(values):
+    values = sorted(round(v, 1) for v in values)
+    return {
+        "count": len(values),
+        "p50_us": percentile(values, 50),
+        "p99_us": percentile(values, 99),
+        "p999_us": percentile(values, 99.9),
+        "max_us": values[-1] if values else None,
+    }
+
+
+def fetch_stats(args, path="/stats"):
+    try:
+        status, body = request(args.host, args.port, path, args.timeout)
+        if status == 200:
+            return json.loads(body)
+    except (OSError, http.client.HTTPException, ValueError):
+        pass
+    return None
+
+
+def run_benchmark(args):
+    mix = MIXES[args.mix]
+    scenarios = list(mix.keys())
+    weights = [mix[s] for s in scenarios]
+
+    # Counts and times are diffed anyway, the reset makes the max/min fields per run
+    try:
+        status, _ = request(args.host, args.port, "/stats/reset", args.timeout)
+        counters_reset = status == 200
+    except (OSError, http.client.HTTPException):
+        counters_reset = False
+    stats_before = fetch_stats(args)
+
+    deadline = time.monotonic() + args.duration
+    workers = [Worker(args, scenarios, weights, deadline, args.seed + i) for i in range(args.concurrency)]
+
+    start = time.monotonic()
+    for w in workers:
+        w.start()
+    for w in workers:
+        w.join()
+    wall = time.monotonic() - start
+
+    stats_after = fetch_stats(args)
+
+    per_route = {}
+    for w in workers:
+        for label, values in w.samples.items():
+            per_route.setdefault(label, []).extend(values)
+
+    all_values = [v for values in per_route.values() for v in values]
+    errors = sum(w.errors for w in workers)
+
+    result = {
+        "config": {
+            "host": args.host,
+            "port": args.port,
+            "mix": args.mix,
+            "duration_s": args.duration,
+            "concurrency": args.concurrency,
+            "think_ms": args.think_ms,
+            "seed": args.seed,
+        },
+        "wall_s": round(wall, 3),
+        "requests": len(all_values),
+        "errors": errors,
+        "throughput_rps": round(len(all_values) / wall, 2) if wall > 0 else 0,
+        "latency": latency_summary(all_values),
+        "routes": {label: latency_summary(values) for label, values in per_route.items()},
+    }
+
+    if stats_after is not None:
+        result["server"] = server_summary(stats_before, stats_after, counters_reset)
+        result["server"]["heap_free"] = stats_after.get("heap_free")
+
+        # Busy/idle accounting of the control server, since /stats/reset
+        utilisation = fetch_stats(args, "/utilisation")
+        if utilisation is not None:
+            result["server"]["utilisation"] = utilisation
+
+    return result
+
+
+def server_summary(before, after, counters_reset):
+    """
+    Handler side cost per route over the run, from the /stats counters.
+
+    Max and min values cannot be diffed: when the counters could not be reset
+    before the run they cover the whole uptime, and are reported with a
+    "_since_boot" suffix so --compare never takes them as per run numbers.
+    """
+    before_routes = (before or {}).get("routes", {})
+    suffix = "" if counters_reset else "_since_boot"
+    routes = {}
+
+    for label, s in after.get("routes", {}).items():
+        b = before_routes.get(label, {"count": 0, "total_us": 0})
+        count = s["count"] - b["count"]
+        if count <= 0:
+            continue
+
+        routes[label] = {
+            "count": count,
+            "handler_mean_us": round((s["total_us"] - b["total_us"]) / count, 1),
+            "handler_max_us" + suffix: s["max_us"],
+            "heap_peak_max" + suffix: s["heap_peak_max"],
+            "heap_free_min" + suffix: s["heap_free_min"],
+        }
+
+        if "mallocs" in s:
+            b_mallocs = b.get("mallocs", 0)
+            routes[label]["mallocs_per_request"] = round((s["mallocs"] - b_mallocs) / count, 2)
+
+    return {"counters_reset": counters_reset, "routes": routes}
+
+
+def compare(old_path, new_path):
+    with open(old_path) as f:
+        old = json.load(f)
+    with open(new_path) as f:
+        new = json.load(f)
+
+    def row(name, a, b):
+        if a is None or b is None:
+            print(f"{name:40s} {str(a):>12s} {str(b):>12s}")
+            return
+        change = ((b - a) / a * 100.0) if a else 0.0
+        print(f"{name:40s} {a:12.1f} {b:12.1f} {change:+8.1f}%")
+
+    print(f"{'metric':40s} {'old':>12s} {'new':>12s} {'change':>9s}")
+    row("throughput_rps", old["throughput_rps"], new["throughput_rps"])
+    for key in ("p50_us", "p99_us", "p999_us"):
+        row("latency." + key, old["latency"][key], new["latency"][key])
+
+    for label in sorted(set(old["routes"]) | set(new["routes"])):
+        for key in ("p50_us", "p99_us"):
+            row(f"{label}.{key}",
+                old["routes"].get(label, {}).get(key),
+                new["routes"].get(label, {}).get(key))
+
+    old_server = old.get("server", {}).get("routes", {})
+    new_server = new.get("server", {}).get("routes", {})
+    for label in sorted(set(old_server) | set(new_server)):
+        for key in ("handler_mean_us", "heap_peak_max", "mallocs_per_request"):
+            row(f"server.{label}.{key}",
+                old_server.get(label, {}).get(key),
+                new_server.get(label, {}).get(key))
+
+    old_util = old.get("server", {}).get("utilisation", {})
+    new_util = new.get("server", {}).get("utilisation", {})
+    for key in ("utilisation", "served_wait_bound_max_us"):
+        row(f"server.{key}", old_util.get(key), new_util.get(key))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", help="device address (use 8.8.8.8 for the setup portal)")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--mix", choices=sorted(MIXES), default="dashboard")
+    parser.add_argument("--duration", type=float, default=30.0, help="run time in seconds")
+    parser.add_argument("--concurrency", type=int, default=1, help="parallel clients")
+    parser.add_argument("--think-ms", type=float, default=0.0, help="pause between requests of a client")
+    parser.add_argument("--timeout", type=float, default=5.0, help="per request timeout in seconds")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--allow-ir", action="store_true", help="allow mixes that send IR frames through /send")
+    parser.add_argument("-o", "--output", help="write the JSON report to this file")
+    parser.add_argument("--compare", nargs=2, metavar=("OLD", "NEW"), help="diff two JSON reports")
+    args = parser.parse_args()
+
+    if args.compare:
+        compare(*args.compare)
+        return 0
+
+    if not args.host:
+        parser.error("--host is required")
+
+    if not args.allow_ir and any(uses_ir(s) for s in MIXES[args.mix]):
+        parser.error(f"mix '{args.mix}' sends IR frames to the air conditioner, add --allow-ir")
+
+    report = json.dumps(run_benchmark(args), indent=2, sort_keys=True)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(report + "\n")
+    else:
+        print(report)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+Decode the event trace served on /trace (see src/trace.h) into a timeline.
+
+Examples:
+    tools/trace_decode.py http://192.168.1.42/trace
+    curl -s http://8.8.8.8/trace -o trace.bin && tools/trace_decode.py trace.bin
+    tools/trace_decode.py trace.bin --json
+
+Timestamps are millis() of the boot that recorded the event, each BOOT line
+starts a new boot. Only the Python standard library is used.
+"""
+
+import argparse
+import json
+import struct
+import sys
+import urllib.request
+
+TRACE_MAGIC = 0x31435254
+HEADER = struct.Struct("<III")
+RECORD = struct.Struct("<IBBH")
+
+# Same order as TraceEvent in src/trace.h
+EVENTS = [
+    "BOOT",
+    "HTTP_START",
+    "HTTP_END",
+    "IR_START",
+    "IR_END",
+    "WIFI_STATUS",
+    "EEPROM_COMMIT",
+    "HEAP_LOW",
+]
+
+# Same order as RouteId in src/request_stats.h
+ROUTES = [
+    "temperature_get",
+    "temperature_set",
+    "stream_mode_get",
+    "stream_mode_set",
+    "on_off_get",
+    "on_off_set",
+    "send",
+    "room_temperature_get",
+    "thermostat_get",
+    "thermostat_set",
+    "stats",
+    "trace",
+    "utilisation",
+    "not_found",
+    "portal_root",
+    "portal_settings",
+    "portal_restart",
+    "portal_not_found",
+]
+
+# Names returned by StatusToString() in src/utils.h
+WIFI_STATUS = {
+    0: "WL_IDLE_STATUS",
+    1: "WL_NO_SSID_AVAIL",
+    2: "WL_SCAN_COMPLETED",
+    3: "WL_CONNECTED",
+    4: "WL_CONNECT_FAILED",
+    5: "WL_CONNECTION_LOST",
+    6: "WL_WRONG_PASSWORD",
+    7: "WL_DISCONNECTED",
+    255: "WL_NO_SHIELD",
+}
+
+# rst_info.reason of the ESP8266 SDK
+RESET_REASONS = {
+    0: "power on",
+    1: "hardware watchdog",
+    2: "exception",
+    3: "software watchdog",
+    4: "software restart",
+    5: "deep sleep wake up",
+    6: "external reset",
+}
+
+EEPROM_FIELDS = {
+    0: "ssid",
+    32: "password",
+}
+
+
+def read_dump(source):
+    if source.startswith("http://") or source.startswith("https://"):
+        with urllib.request.urlopen(source, timeout=10) as response:
+            return response.read()
+
+    if source == "-":
+        return sys.stdin.buffer.read()
+
+    with open(source, "rb") as f:
+        return f.read()
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        raise ValueError("trace dump too short")
+
+    magic, count, capacity = HEADER.unpack_from(data, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError(f"bad trace magic 0x{magic:08x}")
+
+    records = []
+    for offset in range(HEADER.size, len(data) - RECORD.size + 1, RECORD.size):
+        timestamp, event, arg, value = RECORD.unpack_from(data, offset)
+        records.append({"timestamp_ms": timestamp, "event": event, "arg": arg, "value": value})
+
+    return {"count": count, "capacity": capacity, "lost": max(0, count - capacity), "records": records}
+
+
+def name(table, index):
+    if isinstance(table, dict):
+        return table.get(index, f"#{index}")
+    return table[index] if index < len(table) else f"#{index}"
+
+
+def describe(record):
+    event = name(EVENTS, record["event"])
+    arg = record["arg"]
+    value = record["value"]
+
+    if event == "BOOT":
+        return f"reason={name(RESET_REASONS, arg)}"
+    if event == "HTTP_START":
+        return f"route={name(ROUTES, arg)}"
+    if event == "HTTP_END":
+        return f"route={name(ROUTES, arg)} duration={value}ms"
+    if event == "IR_END":
+        return f"duration={value}ms"
+    if event == "WIFI_STATUS":
+        return name(WIFI_STATUS, arg)
+    if event == "EEPROM_COMMIT":
+        return f"field={name(EEPROM_FIELDS, arg)}"
+    if event == "HEAP_LOW":
+        return f"free={value}B"
+    return ""
+
+
+def print_timeline(trace):
+    print(f"{trace['count']} events recorded, {len(trace['records'])} kept, {trace['lost']} overwritten")
+
+    boot = 0
+    for record in trace["records"]:
+        event = name(EVENTS, record["event"])
+
+        if event == "BOOT":
+            boot += 1
+            print(f"--- boot {boot} ---")
+
+        seconds = record["timestamp_ms"] / 1000.0
+        print(f"{seconds:12.3f}s  {event:14s} {describe(record)}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="/trace URL, dump file or - for stdin")
+    parser.add_argument("--json", action="store_true", help="print the decoded records as JSON")
+    args = parser.parse_args()
+
+    try:
+        trace = parse(read_dump(args.source))
+    except (OSError, ValueError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    if args.json:
+        for record in trace["records"]:
+            record["description"] = describe(record)
+            record["event"] = name(EVENTS, record["event"])
+        print(json.dumps(trace, indent=2))
+    else:
+        print_timeline(trace)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())